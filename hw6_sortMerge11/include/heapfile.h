@@ -17,9 +17,11 @@
 //
 //  The first directory page is a header page for the entire database
 //  (it is the one to which our filename is mapped by the DB).
-//  All directory pages are in a doubly-linked list of pages, each
-//  directory entry points to a single data page, which contains
-//  the actual records.
+//  The other directory pages are in a list chained from the header
+//  page, each directory entry points to a single data page, which
+//  contains the actual records.  The data pages are in a list of
+//  their own, starting at the next page of the header page, so that
+//  scans need not read the directory.
 //
 //  The heapfile data pages are implemented as slotted pages, with
 //  the slots at the front and the records in the back, both growing
@@ -29,7 +31,9 @@
 //  We can store roughly pagesize/sizeof(DataPageInfo) records per
 //  directory page; for any given HeapFile insertion, it is likely
 //  that at least one of those referenced data pages will have
-//  enough free space to satisfy the request.
+//  enough free space to satisfy the request.  The directory is read
+//  into memory on the first insertion or deletion, so an insertion
+//  pins the data page it goes to and the directory page of its entry.
 
 
 // Error codes for HEAPFILE.
@@ -48,11 +52,21 @@ enum heapErrCodes {
 // DataPageInfo: the type of records stored on a directory page:
 
 struct DataPageInfo {
-	PageId	pageId;
-	char	filler[4];
-  //int    availspace;  // HFPage returns int for avail space, so we use int here
-  //int    recct;       // for efficient implementation of getRecCnt()
-  //PageId pageId;      // obvious: id of this particular data page (a HFPage)
+  int    availspace;  // HFPage returns int for avail space, so we use int here
+  PageId pageId;      // obvious: id of this particular data page (a HFPage)
+};
+
+// HeapFileInfo: the first record of the header page.  The rest of the
+// header page holds DataPageInfo records, as do the directory pages
+// chained from it.  The data pages form their own list, which starts
+// at the next page of the header page.
+
+struct HeapFileInfo {
+  PageId lastPageId;  // last page of the data page list
+  PageId dirPageId;   // first directory page after the header page
+  int    recCnt;      // records in the file
+  int    pageCnt;     // data pages in the file
+  int    version;     // counts the data pages added or removed
 };
 
 
@@ -70,6 +84,9 @@ class HeapFile {
       // return number of records in file
     int getRecCnt();
 
+      // return number of data pages in file
+    int getPageCnt();
+
       // insert record into file
     Status insertRecord(char *recPtr, int recLen, RID& outRid);
 
@@ -85,12 +102,57 @@ class HeapFile {
       // initiate a sequential scan
     class Scan *openScan(Status& status);
 
+      // initiate a bulk load at the end of the file (see runwriter.h)
+    class RunWriter *openWriter(Status& status);
+
       // delete the file from the database
     Status deleteFile();
 
 
   private:
     friend class Scan;
+    friend class RunWriter;
+
+      // Read the directory into memory, if it is not there yet.
+    Status loadDirectory();
+
+      // Write the cached entry of a data page back to the directory.
+    Status storeEntry(int entry);
+
+      // Add recs and pages to the counts of the header record, on the
+      // page itself, and set its last page and first directory page to
+      // lastPageId and dirPageId unless they are INVALID_PAGE.  The rest
+      // of the record is left as other HeapFile objects on the file may
+      // have written it, and the cached copy is refreshed from it.
+    Status storeInfo(int recs, int pages, PageId lastPageId = INVALID_PAGE,
+                     PageId dirPageId = INVALID_PAGE);
+
+      // Read the header record off the header page.
+    Status readInfo(HeapFileInfo& info);
+
+      // Add a new data page to the directory, or drop a freed one.
+    Status addEntry(PageId pageId, int availspace);
+    Status removeEntry(int entry);
+
+      // The cached entry of a data page, or -1.
+    int findEntry(PageId pageId);
+
+      // The entry of the data page a RID names, or DONE if the page is
+      // not one of this file's.  On a miss the directory is read again,
+      // but only if data pages were added or removed since it was read.
+    Status ownPage(PageId pageId, int& entry);
+
+      // Link a new data page in at the end of the list and put the
+      // record on it.
+    Status appendPage(char *recPtr, int recLen, RID& outRid);
+
+      // The last page of the data page list, or the header page if
+      // there are no data pages.
+    Status lastPage(PageId& pageId);
+
+      // Enter a page a RunWriter added records to: the last page it
+      // found, or one it linked in.
+    Status notePage(PageId pageId, int availspace, int added, bool linked);
 
     enum Filetype {
         TEMP,
@@ -99,6 +161,7 @@ class HeapFile {
 
     PageId      _firstPageId;    // page number of header page
     Filetype    _ftype;
+    struct HeapDirectory *_dir;  // the directory, once read in
     bool        _file_deleted;
     char       *_fileName;
 };
@@ -0,0 +1,114 @@
+/* -*- C++ -*- */
+/*
+ * runwriter.h - class RunWriter
+ */
+
+#ifndef _RUN_WRITER_H_
+#define _RUN_WRITER_H_
+
+#include "minirel.h"
+#include "page.h"
+
+// ***********************************************************
+// A RunWriter appends records to the end of a heapfile.
+//
+// HeapFile::insertRecord pins a data page and a directory page for
+// every record.  A RunWriter instead keeps the last page pinned, packs
+// records onto it until it is full and then links in the next page;
+// the directory is written once per page.
+// Pages are allocated an extent at a time, so a file written by one
+// writer lies in runs of consecutive pages of the database.
+//
+// Nothing else may insert into the file while a writer is open on it.
+// To load a file, open a writer with HeapFile::openWriter and append the
+// records, a batch at a time if they are at hand together.
+//
+// With a RunCodec, the records are coded one after the other into a
+// block that fills the room left on the last page, and each block is
+// stored as a single record (see runcodec.h).  Such a file holds blocks,
+// not records, and only the reader of a sort run can make sense of it.
+//
+// A writer can also fill a scratch file of the spill area (see spill.h).
+// The last page is then kept in memory rather than pinned, and each page
+// is appended to the file once it is full, with the page list of a
+// heapfile: page i links to page i+1.  The run starts at the end of the
+// file, and its last page may link on to a run written before, which is
+// then read after it: a run can so be written back to front, a piece at
+// a time, as long as each piece sorts before the one written before it.
+
+// pages allocated at a time
+#define RUN_EXTENT 8
+
+class HeapFile;
+class HFPage;
+class RunCodec;
+class SpillFile;
+
+class RunWriter {
+
+  public:
+    // Finds the last page of hf and pins it.  The directory of hf is
+    // brought up to date as pages are filled.
+    RunWriter(HeapFile* hf, Status& status, const RunCodec* codec = NULL);
+
+    // Starts a run after the last page of the scratch file sf.  Its last
+    // page links to page then, if any.
+    RunWriter(SpillFile* sf, Status& status, const RunCodec* codec = NULL,
+              PageId then = INVALID_PAGE);
+   ~RunWriter();
+
+    // Append a record to the file.  A coded record gets no RID.
+    Status append(char* recPtr, int recLen, RID& outRid);
+
+    // Append the n records of recLen bytes each that lie one after the
+    // other from recs, and store their RIDs in rids unless it is NULL.
+    Status appendBatch(char* recs, int recLen, int n, RID* rids = NULL);
+
+    // Unpin the last page and give back the unused rest of the extent,
+    // or append it to the scratch file and flush that.  Also done by the
+    // destructor.
+    Status close();
+
+    // Pages written to: the last page found plus those linked in.
+    int pages() { return pageCnt; }
+
+    // The first page written to a scratch file, where the run starts.
+    PageId first() { return firstId; }
+
+  private:
+    void init(const RunCodec* runCodec);
+
+    // Link a new page in after the last one and pin it instead.
+    Status newTailPage();
+
+    // Enter the last page in the directory of the heapfile.
+    Status noteTail();
+
+    // Code a record into the block, storing the block first if full.
+    Status appendCoded(char* recPtr, int recLen);
+
+    // Store the block as a record of the last page.
+    Status storeBlock();
+
+    HFPage *tail;       // last page of the file, pinned; NULL once closed
+    PageId  tailId;
+    PageId  nextId;     // next unused page of the current extent
+    int     left;       // unused pages of the current extent
+    int     pageCnt;
+    HeapFile  *file;    // the heapfile written, or NULL
+    bool    linked;     // the last page was linked in by the writer
+    int     tailRecs;   // records the writer put on the last page
+    SpillFile *spill;   // the scratch file written, or NULL
+    char   *spillPage;  // its last page
+    PageId  firstId;    // the first page written to it
+    PageId  thenId;     // the page its last page links to
+
+    const RunCodec* codec;
+    char   *block;      // records coded so far
+    int     blockLen;
+    int     blockMax;   // room for the block on the last page, 0 if none
+    char   *prev;       // the record coded last
+    char   *coded;      // one record, coded
+};
+
+#endif
@@ -19,18 +19,26 @@
 // of a HeapFile. It supports the getNext interface which will
 // simply retrieve the next record in the heapfile.
 //
-// An object of type scan will always have pinned one directory page
-// of the heapfile.
+// A scan follows the list of data pages from the header page, and
+// keeps the data page it is on pinned, and no other.
 
 class HeapFile;
 class HFPage;
 
+// A record of the page a scan is on, read in place (see getNextBatch).
+struct RecordView {
+    RID   rid;
+    char *recPtr;
+    int   recLen;
+};
+
+// Views a caller usually asks for at a time.
+#define SCAN_BATCH 32
+
 class Scan {
 
   public:
-    // The constructor pins the first directory page in the file
-    // and initializes its private data members from the private
-    // data member from hf
+    // The constructor pins the first data page of the file.
     Scan(HeapFile* hf, Status& status);
    ~Scan();
 
@@ -42,29 +50,26 @@ class Scan {
     // Returns OK if successful, non-OK otherwise.
     Status position(RID rid);
 
+    // Batch access: points views[0..count-1] at the next records, at most
+    // max of them and all on one page, without copying them.  The page
+    // stays pinned by the scan until the next call, which is as long as
+    // the views are valid.  Returns DONE after the last record.  May be
+    // mixed with getNext.
+    Status getNextBatch(RecordView* views, int max, int& count);
+
   private:
     /*
      * See heapfile.h for the overall description of a heapfile.
      * (Then see hfpage.h for HFPage ops.)
      *
-     * Note that one record in our way-cool HeapFile implementation is
-     * specified by six (6) parameters, some of which can be determined
-     * from others:
+     * The scan does not read the directory: the data pages are linked
+     * from the header page, and where the scan is is given by the data
+     * page and the record on it.
      */
 
     // The heapfile we are using.
     HeapFile  *_hf;
 
-    // PageId of current directory page (which is itself an HFPage)
-    PageId dirpageId;
-
-    // pointer to in-core data of dirpageId (page is pinned)
-    HFPage *dirpage;
-
-    // record ID of the DataPageInfo struct (in the directory page) which
-    // describes the data page where our current record lives.
-    RID datapageRid;
-
     // the actual PageId of the data page with the current record
     PageId datapageId;
 
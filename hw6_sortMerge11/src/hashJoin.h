@@ -0,0 +1,95 @@
+#ifndef __HASH_JOIN_
+#define __HASH_JOIN_
+
+#include "minirel.h"
+#include "scan.h"
+#include "heapfile.h"
+#include "runwriter.h"
+#include "new_error.h"
+#include "system_defs.h"
+#include "sortMerge.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Hybrid hash join.  The smaller input is the build side.  If its hash table
+// fits in amt_of_mem pages the join is done in memory with one scan of each
+// input.  Otherwise both inputs are partitioned to temporary heapfiles; the
+// first partition of the build side stays in memory and is probed while the
+// probe side is being partitioned, and every spilled partition pair is then
+// joined recursively with a new hash function.  A partition that will not
+// split any further (one very common key) is joined in memory-sized chunks.
+//
+// The output tuples are R followed by S, as for sortMerge, but in no
+// particular order.
+
+class hashJoin
+{
+
+ public:
+   hashJoin(
+	char*		filename1,			// Name of heapfile for relation R
+	int     	len_in1,			// # of columns in R.
+	AttrType    in1[],				// Array containing field types of R.
+	short   	t1_str_sizes[],		// Array containing size of columns in R
+	int     	join_col_in1,		// The join column of R
+
+	char*		filename2,			// Name of heapfile for relation S
+	int     	len_in2,			// # of columns in S.
+	AttrType    	in2[],			// Array containing field types of S.
+	short   	t2_str_sizes[],		// Array containing size of columns in S
+	int     	join_col_in2,		// The join column of S
+
+	char*		filename3,			// Name of heapfile for joined results
+	int     	amt_of_mem,			// Number of pages available
+	Status& 	s					// Status of constructor
+   );
+
+~hashJoin();
+
+private:
+	// Joins build with probe, partitioning first if the build side does
+	// not fit in memory.  level selects the hash function.
+	Status _join(HeapFile* build, HeapFile* probe, int level);
+
+	// Builds the table from build in memory-sized chunks and scans probe
+	// once per chunk.
+	Status _table_join(HeapFile* build, HeapFile* probe);
+
+	// Splits one input over numParts spill files.  Records of the resident
+	// partition go into (build side) or probe (probe side) the hash table.
+	Status _partition(HeapFile* in, int side, int level, int numParts,
+					  int cut0, HeapFile** parts, HeapFile** buildParts);
+
+	// Moves the resident partition to a spill file when it outgrows memory.
+	Status _spill_resident(HeapFile*& part, RunWriter*& writer);
+
+	void   _table_init(int bytes);
+	bool   _table_insert(const char* rec);
+	Status _table_probe(const char* rec);
+	void   _table_clear();
+
+	unsigned int _hash(const char* rec, int side, int seed);
+	bool   _key_eq(const char* buildRec, const char* probeRec);
+	Status _emit(const char* buildRec, const char* probeRec);
+
+	int			_len[2];		// tuple length of R and S
+	int			_pos[2];		// join key offset in R and S
+	int			_key_size;
+	AttrType	_key_type;
+	int			_build;			// 0 if R is the build side, 1 if S is
+	int			_mem_pages;		// amt_of_mem
+
+	char*		_arena;			// hash table entries: [next][tuple]
+	int			_arena_bytes;
+	int			_entry_len;
+	int			_num_entries;
+	int			_max_entries;
+	int*		_buckets;
+	unsigned int _num_buckets;
+	bool		_resident;		// the resident partition is still in memory
+
+	char*		_out_rec;		// scratch space for one joined tuple
+	RunWriter*	_out_file;		// appends to the output file
+};
+
+#endif
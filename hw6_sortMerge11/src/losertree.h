@@ -0,0 +1,108 @@
+#ifndef __LOSER_TREE_
+#define __LOSER_TREE_
+
+// Tournament tree of losers for a k-way merge.  Inputs are numbered 0..k-1;
+// the tree never looks at records itself, it asks cmp(a,b) to compare the
+// current records of inputs a and b (negative, zero or positive, like
+// strcmp).  Ties go to the lower input, so the merge is stable.
+//
+// Node 0 holds the overall winner and nodes 1..k-1 the loser of the match
+// played there; input i is the leaf at position k+i.  When the winner's
+// input moves on to its next record, only the matches on its path to the
+// root are replayed: about log2(k) comparisons per record.  An exhausted
+// input loses every match, so it needs no further attention.
+
+// What a merge needs of a loser tree, whatever its comparator.
+class MergeTree
+{
+ public:
+	virtual ~MergeTree() {}
+	virtual void exhaust(int input) = 0;
+	virtual void build() = 0;
+	virtual int winner() = 0;
+	virtual void replay(bool exhausted) = 0;
+};
+
+template <class Compare>
+class LoserTree : public MergeTree
+{
+ public:
+	LoserTree(int number, Compare cmp) : _cmp(cmp)
+	{
+		// a merge of no inputs has a single, exhausted, slot
+		int size = (number > 0) ? number : 1;
+		_number = number;
+		_node = new int[size];
+		_done = new bool[size];
+		for (int i=0; i<size; i++) {
+			_node[i] = i;
+			_done[i] = (number == 0);
+		}
+	}
+
+	~LoserTree()
+	{
+		delete [] _node;
+		delete [] _done;
+	}
+
+	// Marks an input that has no records at all.  Call before build().
+	void exhaust(int input) { _done[input] = true; }
+
+	// Plays the whole tournament, once the first record of every input
+	// is in place.
+	void build()
+	{
+		if (_number == 0) return;
+		int* win = new int[2*_number];
+		for (int i=0; i<_number; i++)
+			win[_number+i] = i;
+		for (int n=_number-1; n>=1; n--) {
+			int a = win[2*n], b = win[2*n+1];
+			if (_beats(a,b)) {
+				win[n] = a;
+				_node[n] = b;
+			} else {
+				win[n] = b;
+				_node[n] = a;
+			}
+		}
+		_node[0] = win[1];
+		delete [] win;
+	}
+
+	// The input holding the least current record, or -1 once all inputs
+	// are exhausted.
+	int winner() { return _done[_node[0]] ? -1 : _node[0]; }
+
+	// The winner has moved on to its next record, or has run out.
+	void replay(bool exhausted)
+	{
+		int w = _node[0];
+		if (exhausted) _done[w] = true;
+		for (int n=(w+_number)/2; n>=1; n/=2) {
+			if (_beats(_node[n],w)) {
+				int t = _node[n];
+				_node[n] = w;
+				w = t;
+			}
+		}
+		_node[0] = w;
+	}
+
+ private:
+	bool _beats(int a, int b)
+	{
+		if (_done[a]) return false;
+		if (_done[b]) return true;
+		int c = _cmp(a,b);
+		return c < 0 || (c == 0 && a < b);
+	}
+
+	int			_number;
+	Compare		_cmp;
+	int*		_node;		// winner at 0, losers at 1..number-1
+	bool*		_done;		// exhausted inputs
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef __READ_AHEAD_
+#define __READ_AHEAD_
+
+#include <pthread.h>
+#include "minirel.h"
+
+class HFPage;
+class SpillFile;
+
+// Reads the pages of several scratch files of the spill area (see spill.h)
+// ahead of a merge.  A thread of its own follows the page list of each
+// file and reads its pages into a ring of depth frames per file, while the
+// merge works through the pages already read.  It always serves the file
+// with the fewest pages ready, which is the one the merge is most likely
+// to wait on.
+//
+// The files must be flushed and must not change while they are read.
+// With depth 1 there is no read-ahead, as the only frame of a file is the
+// one being merged.
+
+class ReadAhead
+{
+ public:
+	// Reads the scratch files files[0..number-1], each from page first[i].
+	ReadAhead(int number, SpillFile* const* files, const PageId* first,
+			  int depth);
+	~ReadAhead();
+
+	// Starts the thread.  Without one, next() reads each page itself.
+	void start();
+
+	// Points page at the next page of file i, or sets it to NULL after the
+	// last.  The page stays valid until the next call for the same file.
+	Status next(int i, HFPage*& page);
+
+ private:
+	static void* _run(void* arg);
+	void _work();
+	int _pick();
+	Status _read(int i);
+	char* _frame(int i, int slot) { return &_frames[(i*_depth + slot)*MINIBASE_PAGESIZE]; }
+
+	int			_number;
+	int			_depth;			// frames per file
+	SpillFile**	_files;			// scratch files read
+	char*		_frames;
+	PageId*		_next;			// next page of each file to read
+	int*		_start;			// oldest frame of each file in use
+	int*		_ready;			// frames of each file read, from _start on
+	bool*		_held;			// the frame at _start is handed out
+	Status		_status;		// first failed read
+	bool		_stop;
+	bool		_threaded;
+	pthread_t	_thread;
+	pthread_mutex_t _lock;
+	pthread_cond_t _filled;		// a page was read, or a read failed
+	pthread_cond_t _freed;		// a frame was given back
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef __RUN_CODEC_
+#define __RUN_CODEC_
+
+#include "minirel.h"
+
+// Packs the records of a sorted run.  Each record is coded against the one
+// before it, which in a sorted run has a close key and often much else in
+// common:
+//
+//	- an attrInteger key as the difference from the key before, zigzagged
+//	  so that small steps either way take a byte;
+//	- an attrString key as the length of the prefix it shares with the key
+//	  before, and the bytes after it up to its trailing zeros;
+//	- everything else, an attrReal key too, as alternating spans of bytes
+//	  equal to those of the record before and bytes given in full.
+//
+// Lengths are varints.  The coded records make up blocks, each a record of
+// its own on a page of the run (see RunWriter); the first record of a
+// block is coded against a record of zeros, so every block decodes by
+// itself.
+
+class RunCodec
+{
+ public:
+	// The key is keySize bytes of type keyType at keyPos of records of
+	// recLen bytes.
+	RunCodec(AttrType keyType, int keyPos, int keySize, int recLen);
+	~RunCodec();
+
+	// The most bytes one coded record can take.
+	int maxEncoded() const { return _rec_len + 16; }
+
+	// Codes rec against prev, or against zeros if prev is NULL, into out.
+	// Returns the number of bytes written.
+	int encode(const char* prev, const char* rec, char* out) const;
+
+	// Decodes the record at in into rec, which holds the record before it,
+	// or zeros at the start of a block.  Returns the number of bytes read.
+	int decode(const char* in, char* rec) const;
+
+	// Fills rec with the record a block starts against.
+	void startBlock(char* rec) const;
+
+ private:
+	int _encodeSpans(const char* prev, const char* rec, int from, int to,
+					 char* out) const;
+	int _decodeSpans(const char* in, char* rec, int from, int to) const;
+
+	AttrType	_key_type;
+	int			_key_pos;
+	int			_key_size;
+	int			_rec_len;
+	char*		_zeros;		// record of zeros
+};
+
+#endif
@@ -4,9 +4,102 @@
 #include "minirel.h"
 #include "new_error.h"
 #include "scan.h"
+#include "runwriter.h"
+#include "readahead.h"
+#include "tuplecmp.h"
+#include "runcodec.h"
+#include "spill.h"
 
 #define    PAGESIZE    MINIBASE_PAGESIZE
 
+// How the first pass cuts the input into sorted runs.
+enum RunGeneration {
+	QuickSortRuns,			// qsort each memory load: runs are memory-sized.
+							// Wide records are not moved; entries of their
+							// key prefix and position are sorted instead.
+	ReplacementSelection,	// heap of the memory load: runs average twice the
+							// memory, and sorted input gives a single run
+	RadixSortRuns			// radix sort normalized keys of each memory load,
+							// then write the records in key order.  The keys
+							// take memory, so runs are shorter.
+};
+
+// Error handling protocal: the codes of the JOINS subsystem, shared by
+// Sort and all join operators.  The messages are registered in sortMerge.C.
+
+enum joinErrCodes 	{
+	SORT_FAILED,
+	HEAPFILE_FAILED,
+	KEY_TYPE_MISMATCH,
+	KEY_TYPE_UNSUPPORTED,
+	AGGREGATE_UNSUPPORTED
+};
+
+// A sorted run on disk, in a scratch file of the spill area.  A run of
+// pass one made of loads in descending order is written back to front, so
+// it starts at the page of the last load written (see runwriter.h).
+struct SortRun {
+	SpillFile* file;
+	PageId first;		// the page the run starts at
+	int pages;
+};
+
+// A heapfile read a batch at a time: the scan keeps the page of the batch
+// pinned and views[next] is the next record on it.
+struct SortInput {
+	Scan* scan;
+	RecordView views[SCAN_BATCH];
+	int next;
+	int count;
+	bool more;		// records left
+};
+
+// The memory of a sort: amt_of_buf pages' worth.  The work areas and
+// records of each phase are taken from it, and the pages of the objects
+// the sort works through, pinned, written or read ahead, are held against
+// it while they are open, so a phase sizes its work area from what is
+// left.  Arrays of pointers and counters are not counted.
+class SortArena
+{
+ public:
+	SortArena(int bytes) : _size(bytes), _used(0), _peak(0) {}
+
+	char* take(int bytes) { hold(bytes); return new char[bytes]; }
+	void give(char* p, int bytes) { delete [] p; drop(bytes); }
+
+	void hold(int bytes)
+	{
+		_used += bytes;
+		if (_used > _peak) _peak = _used;
+	}
+	void drop(int bytes) { _used -= bytes; }
+
+	// bytes not in use, 0 if more than the arena is
+	int left() const { return (_used < _size) ? _size - _used : 0; }
+	int peak() const { return _peak; }
+
+ private:
+	int _size;
+	int _used;
+	int _peak;
+};
+
+// One column of a composite sort key.
+struct SortKey {
+	int field;			// number of the field, from 0
+	TupleOrder order;	// Ascending or Descending
+};
+
+// What a grouping sort computes over the records of a group.
+enum SortAggFunc { AggCount, AggSum, AggMin, AggMax };
+
+// An aggregate of a grouping sort: the field, an attrInteger one, holds
+// the result in the record of the group.
+struct SortAggregate {
+	int field;
+	SortAggFunc func;
+};
+
 class Sort
 {
  public:
@@ -29,27 +122,189 @@ class Sort
 
 		int          amt_of_buf,	// Number of buffer pages available for sorting.
 
-		Status&     s
+		Status&     s,
+
+		int          stream_runs = 0,	// If nonzero, outFile is not written.  Merging
+									// stops once at most stream_runs runs are left,
+									// and getNext() merges those on the fly.  They
+									// are opened on the first call, so a streamed
+									// sort holds no memory until then.
+
+		RunGeneration run_gen = QuickSortRuns,	// How pass one forms its runs.
+
+		int          workers = 1,	// Threads sorting each memory load of
+									// QuickSortRuns.  The load is split among
+									// them, so memory use does not change.
+
+		int          limit = 0,		// If nonzero, only the first limit records
+									// in sort order are output (top-K).  When
+									// they fit in memory they are picked with a
+									// heap in one scan; otherwise pass one runs
+									// as for QuickSortRuns or RadixSortRuns, and
+									// records that cannot make the cut are
+									// dropped as soon as that is known.
+
+		bool         compress_runs = false	// Code the temporary runs with a
+									// RunCodec: fewer pages to write and read
+									// for a little more work per record.
+									// Ignored below 5 pages of memory.
 	);
 
-    ~Sort(){}
+	// Sorts on several key columns, each with its own order: records equal
+	// on keys[0] are ordered by keys[1], and so on.  The columns may be
+	// attrInteger, attrString or attrReal.  The other arguments are as
+	// above.
+	//
+	// With group set, the records equal on all the key columns become one,
+	// as early as pass one, and the fields of aggs hold the aggregates of
+	// the group; the other fields are those of one of its records.  With
+	// no aggregates this is DISTINCT on the key.  A limit then counts
+	// groups.
+	Sort(char* inFile, char* outFile, int len_in, AttrType in[],
+		 short str_sizes[], int num_keys, SortKey keys[], int amt_of_buf,
+		 Status& s, int stream_runs = 0, RunGeneration run_gen = QuickSortRuns,
+		 int workers = 1, int limit = 0, bool group = false, int num_aggs = 0,
+		 SortAggregate aggs[] = NULL, bool compress_runs = false);
+
+    ~Sort();
+
+	// Returns the next record of a streamed sort in recPtr, or DONE after
+	// the last one.
+	Status getNext(char* recPtr, int& recLen);
+
+	// The number of runs getNext() merges, i.e. pages it keeps pinned.
+	int runs() { return _num_runs; }
+
+	// Pages the merges were planned to write, from the sizes of the runs
+	// of pass one, and the pages they did write.
+	int pagesPlanned() { return _pages_planned; }
+	int pagesWritten() { return _pages_written; }
+
+	// The most memory, in bytes, the sort held at once: its work area and
+	// records, the pages it pinned or read ahead and the buffers of the
+	// runs it wrote.  Each phase sizes its work area from what amt_of_buf
+	// leaves, so this is no more than amt_of_buf pages unless that is too
+	// little to merge two runs.
+	int memoryPeak() { return _arena->peak(); }
+
+	// Records of at least this many bytes are sorted by PrefixEntry in
+	// pass one of QuickSortRuns, rather than moved around.  Out of reach,
+	// every load is sorted in place.
+	static int prefixSortLength;
+
  private: 
+	void _init(char* inFile, char* outFile, int len_in, AttrType in[],
+			   short str_sizes[], int num_keys, SortKey keys[], int amt_of_buf,
+			   Status& s, int stream_runs, RunGeneration run_gen, int workers,
+			   int limit, bool group, int num_aggs, SortAggregate aggs[],
+			   bool compress_runs);
     Status _pass_one(int& numtempfile);
-    Status _merge_many_to_one(unsigned int numtempfile, 
-							  HeapFile **source, HeapFile* dest);
-    Status _one_later_pass(int numberTempFiles, int passNum, int &numDest);
-    Status _merge(int numFiles);
-    
-    char* _temp_name(int pass, int run, char* out_file);
+	Status _top_k(int& numtempfile);
+	int _prune(char* area, int n);
+	Status _run_append(RunWriter* dest, char* rec, int i, int n, int run);
+	Status _put(RunWriter* dest, const char* rec);
+	Status _put_end(RunWriter* dest);
+	void _start_group(char* rec);
+	void _combine(char* group, const char* rec);
+	void _add_fence(const char* rec, int run, int rank);
+	void _update_cutoff(int runs);
+	Status _replacement_selection(int& numtempfile);
+	void _add_run(SpillFile* file, PageId first);
+	int _grant(int reserved, int least);
+	int _writer_bytes(bool toOutput, int extent);
+	Status _input_open(SortInput& in, Scan* scan);
+	void _input_close(SortInput& in);
+	Status _input_advance(SortInput& in);
+	Status _input_fill(SortInput& in, char* area, int max, int& n);
+	int _sort_chunks(char* area, int n);
+	Status _write_chunks(RunWriter* dest, char* area, int n, int chunks,
+						 int run, int in_run, char* last);
+	Status _new_run(bool toOutput, RunWriter*& writer, HeapFile*& file,
+					SpillFile*& spill);
+	Status _end_run(RunWriter*& writer, HeapFile*& file, SpillFile*& spill);
+	int _load_order(char* area, int n);
+	void _reverse(char* area, int n);
+	char* _load_record(char* area, char* sorted, int i);
+	char* _load_least(char* area, int n, char* sorted, int chunks);
+	int _load_below(char* area, int n, char* sorted, char* rec);
+	Status _short_run(char* area, int n, char* sorted);
+	Status _spill_output();
+    Status _merge_many_to_one(unsigned int number, RunWriter* dest);
+	int _fan_in(int runs, int left, int width);
+	int _plan(int left, int width);
+	Status _merge_step(int number, bool final);
+    Status _merge();
+
+	// The k-way merge of the first number runs, one record at a time.
+	// _merge_next hands out a pointer to the least record and refills that
+	// input on the next call; a loser tree over the inputs picks the least.
+	// The pages of the runs are read ahead into pages frames.
+	Status _merge_open(unsigned int number, int pages);
+	Status _merge_advance(int input, bool& exhausted);
+	Status _merge_next(char*& recPtr);
+	void _merge_close();
+	Status _open_stream();
+
 
     int _rec_length;
     int _amt_of_buf;
+	SortArena* _arena;			// amt_of_buf pages
+	int _spill_extent;			// pages a run buffers before writing
     char* _in_file;
     char* _out_file;
-    int _fld_no;
-    TupleOrder _sort_order;
     short* _str_sizes;
+	TupleComparator* _cmp;		// compares the sort keys of two records
+	RunCodec* _codec;			// codes the temporary runs, or NULL
+	int _stream_runs;
+	RunGeneration _run_gen;
+	int _workers;
+	int _entry_len;				// bytes of an entry of a sorted load
+	int _entry_rec;				// where in it the record number is
+	int _limit;					// K of a top-K sort, else 0
+	int _handed;				// records getNext() returned
+	bool _streaming;			// getNext() opened the runs
+
+	// Every sorted run is written through _put, which collapses groups
+	// and stops a top-K sort.  The last group stays in _held until a
+	// record of the next one shows up.
+	bool _grouping;
+	int _num_aggs;
+	SortAggFunc* _agg_func;
+	int* _agg_pos;				// offset of the field of each aggregate
+	char* _held;				// the group being collapsed
+	bool _holding;
+	int _put_count;				// records put to the run so far
+
+	// A top-K sort that does not fit in memory keeps a few sample records
+	// of each run of pass one, and from them a cutoff: at least K records
+	// are known to be no greater, so any greater one is dropped.
+	char* _cutoff;				// NULL until K records are known
+	char* _fences;				// the samples, in key order
+	int* _fence_run;			// run of each sample
+	int* _fence_rank;			// records of its run up to the sample
+	int _num_fences;
+	int _max_fences;
+
+	// the runs on disk, smallest first while merging
+	SortRun* _runs;
+	int _num_runs;
+	int _max_runs;				// size of _runs
+	int _pages_planned;
+	int _pages_written;
 
+	// state of the merge in progress
+	unsigned int _m_number;		// number of inputs
+	ReadAhead* _m_read;			// reads the pages of the inputs
+	HFPage** _m_page;			// current page of each input
+	RID* _m_rid;				// current record on it
+	char** _m_pos;				// with _codec, next record of the block
+	char** _m_end;				// and the end of the block
+	char** _m_current;			// current record of each input: on its page,
+								// or with _codec in its slot of _m_records
+	char* _m_records;
+	int _m_frames;				// bytes of the read-ahead frames
+	MergeTree* _m_tree;
+	int _m_last;				// input handed out last, or -1
 };
 
 
@@ -15,9 +15,7 @@ extern SystemDefs* minibase_globals;
 /*extern int tupleCmp(const int len_in1, const AttrType** in1, const int* t1_str_sizes, const int join_col_in1, const in len_in2, const AttrType** in2, const in* t2_str_sizes, const int join_col_in2, TupleOrder order, const char* RecordR, const char* RecordS);
 */
 
-extern int tupleCmp(const void* t1, const void* t2);
-extern int key1_pos;
-extern int key2_pos;
+// The error codes of the JOINS subsystem are declared in sort.h.
 
 class sortMerge 
 {
@@ -45,12 +43,45 @@ class sortMerge
 ~sortMerge();
 
 private:
-	// Error handling protocal:
+	// Merges the sorted streams of R and S into the output file in one pass.
+	Status _merge(Sort* r, Sort* s, char* outFile, int amt_of_mem);
 
-	enum ErrCodes 	{
-		SORT_FAILED,
-		HEAPFILE_FAILED
-	};
+	// Joins one group of equal keys.  On entry rRec and sRec hold the
+	// first tuples of the group; on exit both streams are past it.
+	Status _join_group(Sort* r, char* rRec, bool& rValid,
+					   Sort* s, char* sRec, bool& sValid);
+
+	// Where tuple i of the group of side 0 (R) or 1 (S) is buffered.
+	char* _group_tuple(int side, int i);
+
+	// Whether rec, of side, carries the key of the group, a tuple of
+	// each side of which is in key.
+	bool _in_group(int side, const char* rec, char* const key[2]);
+
+	// Joins rec, of side, with n tuples of the other side from group.
+	Status _join_tuple(int side, const char* rec, const char* group, int n);
+
+	// Reads the next tuple of a stream, clearing valid at the end.
+	Status _next(Sort* sort, char* rec, int len, bool& valid);
+
+	// Compares the join keys of an R and an S tuple, like strcmp.
+	int _cmp(const char* r, const char* s);
+
+	// Concatenates r and s and appends the result to the output file.
+	Status _emit(const char* r, const char* s);
+
+	char* _temp_name(char* out_file, int which);
+
+	int			_rec_len1;		// length of an R tuple
+	int			_rec_len2;		// length of an S tuple
+	int			_key_pos1;		// offset of the join key in R
+	int			_key_pos2;		// offset of the join key in S
+	int			_key_size;		// bytes of the join keys compared
+	TupleComparator* _key_cmp;	// R key against S key
+	char*		_group_area;	// in-memory buffer for a group of duplicates
+	int			_group_bytes;	// size of _group_area
+	char*		_out_rec;		// scratch space for one joined tuple
+	RunWriter*	_out_file;		// appends to the output file
 };
 
 #endif
@@ -0,0 +1,84 @@
+#ifndef __SPILL_
+#define __SPILL_
+
+#include "minirel.h"
+#include "page.h"
+
+// Scratch space for the temporary data of operators, outside the database.
+//
+// A temporary heapfile costs an entry in the database directory, its pages
+// are taken from the space map one extent at a time and handed back page by
+// page when it is deleted, and the file is left behind in the database if
+// the program dies.  A SpillFile is a local file of its own instead, in the
+// directory of a SpillArea.  Its pages are numbered from 0 in the order
+// they are appended, are written an extent at a time in one system call,
+// and can be read back in any order.  The pages of an extent wait in a
+// buffer that is let go of once they are written, so a file no longer
+// appended to costs no memory; with an extent of one page there is no
+// buffer at all.  The file is unlinked as soon as
+// it is created, so closing it, or the end of the program, releases all of
+// it at once.
+//
+// Pages are appended by one writer and read only once it has flushed them.
+// Reads do not share any state, so several threads may read at once.
+
+// most pages written at a time
+#define SPILL_EXTENT 16
+
+// Error codes of the RAWFILE subsystem.
+enum spillErrCodes {
+	SPILL_CREATE_FAILED,
+	SPILL_WRITE_FAILED,
+	SPILL_READ_FAILED,
+	SPILL_BAD_PAGE
+};
+
+class SpillFile
+{
+ public:
+	// Creates an empty scratch file in dir, written extent pages at a
+	// time.
+	SpillFile(const char* dir, int extent, Status& status);
+	~SpillFile();
+
+	// Appends a page, which becomes page pages()-1 of the file.
+	Status append(const Page* page);
+
+	// Writes out the pages appended since the last write, and frees the
+	// buffer.
+	Status flush();
+
+	// Reads page pageNo back.
+	Status read(int pageNo, Page* page) const;
+
+	int pages() const { return _pages; }
+
+ private:
+	Status _write(const char* from, int n);
+
+	int		_fd;
+	int		_extent;
+	char*	_buffer;	// pages not written out yet, or NULL
+	int		_buffered;
+	int		_pages;
+};
+
+class SpillArea
+{
+ public:
+	// Scratch files go in dir.
+	SpillArea(const char* dir);
+	~SpillArea();
+
+	// A new, empty scratch file of this area, written extent pages at a
+	// time.  Each page of the extent is memory the writer holds.
+	SpillFile* create(Status& status, int extent = SPILL_EXTENT);
+
+	// The area operators spill to: $TMPDIR, or /tmp without it.
+	static SpillArea* standard();
+
+ private:
+	char*	_dir;
+};
+
+#endif
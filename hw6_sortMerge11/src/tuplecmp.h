@@ -0,0 +1,658 @@
+#ifndef __TUPLE_CMP_
+#define __TUPLE_CMP_
+
+#include <string.h>
+#include "minirel.h"
+#include "losertree.h"
+
+// Comparison of the keys of two tuples, compiled for one key type and sort
+// order so that it can be inlined into the loops that sort and merge.  A
+// comparator carries its own key positions: the key of t1 is at pos1 and
+// that of t2 at pos2, which differ when a join compares R with S.  Nothing
+// is shared, so any number of sorts and joins can run side by side.
+
+template <AttrType T> struct KeyCmp;
+
+// Besides cmp, each key type can write its key as a normalized key: size
+// bytes that memcmp orders the way cmp orders the keys.
+
+template <> struct KeyCmp<attrInteger>
+{
+	static int cmp(const char* k1, const char* k2, int)
+	{
+		int a, b;
+		memcpy(&a, k1, sizeof(int));
+		memcpy(&b, k2, sizeof(int));
+		return (a > b) - (a < b);
+	}
+
+	static int normalizedLength(int) { return sizeof(int); }
+
+	// big-endian with the sign bit flipped, so negatives come first
+	static void normalize(const char* k, int, unsigned char* out)
+	{
+		unsigned int v;
+		memcpy(&v, k, sizeof(int));
+		v ^= 0x80000000u;
+		for (int i=sizeof(int)-1; i>=0; i--) {
+			out[i] = (unsigned char)v;
+			v >>= 8;
+		}
+	}
+};
+
+template <> struct KeyCmp<attrString>
+{
+	static int cmp(const char* k1, const char* k2, int size)
+	{
+		return strncmp(k1, k2, size);
+	}
+
+	static int normalizedLength(int size) { return size; }
+
+	// strncmp ignores what follows a NUL, so that is zeroed
+	static void normalize(const char* k, int size, unsigned char* out)
+	{
+		int i = 0;
+		for (; i<size && k[i] != '\0'; i++) out[i] = (unsigned char)k[i];
+		for (; i<size; i++) out[i] = 0;
+	}
+};
+
+// NaN is ordered after every other value, and equal to itself, so that the
+// order stays a strict weak one whatever the data.
+template <> struct KeyCmp<attrReal>
+{
+	static int cmp(const char* k1, const char* k2, int)
+	{
+		float a, b;
+		memcpy(&a, k1, sizeof(float));
+		memcpy(&b, k2, sizeof(float));
+		if (a != a || b != b) return (a != a) - (b != b);
+		return (a > b) - (a < b);
+	}
+
+	static int normalizedLength(int) { return sizeof(float); }
+
+	// big-endian IEEE bits: the sign bit flipped for positives and every
+	// bit for negatives, so that more negative comes first.  -0 and 0 come
+	// out different though cmp calls them equal; the order is still right.
+	// Every NaN comes out as all ones, above +infinity.
+	static void normalize(const char* k, int, unsigned char* out)
+	{
+		float f;
+		unsigned int v;
+		memcpy(&f, k, sizeof(float));
+		memcpy(&v, k, sizeof(float));
+		if (f != f)
+			v = 0xffffffffu;
+		else
+			v ^= (v & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+		for (int i=sizeof(float)-1; i>=0; i--) {
+			out[i] = (unsigned char)v;
+			v >>= 8;
+		}
+	}
+};
+
+template <AttrType T, TupleOrder O>
+class TupleCmp
+{
+ public:
+	typedef TupleCmp<T, (O == Ascending) ? Descending : Ascending> Reversed;
+
+	TupleCmp(int pos1, int pos2, int size)
+		: _pos1(pos1), _pos2(pos2), _size(size) {}
+
+	int operator()(const char* t1, const char* t2) const
+	{
+		if (O == Ascending)
+			return KeyCmp<T>::cmp(t1 + _pos1, t2 + _pos2, _size);
+		return KeyCmp<T>::cmp(t2 + _pos2, t1 + _pos1, _size);
+	}
+
+	int normalizedLength() const { return KeyCmp<T>::normalizedLength(_size); }
+
+	// Writes the normalized key of t (a tuple of the first kind); the bytes
+	// are inverted for Descending.
+	void normalize(const char* t, unsigned char* out) const
+	{
+		KeyCmp<T>::normalize(t + _pos1, _size, out);
+		if (O != Ascending)
+			for (int i=KeyCmp<T>::normalizedLength(_size)-1; i>=0; i--)
+				out[i] = ~out[i];
+	}
+
+	Reversed reversed() const { return Reversed(_pos1, _pos2, _size); }
+
+ private:
+	int _pos1, _pos2, _size;
+};
+
+// One column of a sort key: its type, its order, and where it is in the
+// two kinds of tuple compared.
+struct KeyField {
+	AttrType	type;
+	TupleOrder	order;
+	int			pos1;
+	int			pos2;
+	int			size;
+};
+
+// Compares tuples on the column First, a TupleCmp, and where that is equal
+// on Rest: the TupleCmp of the second column, or a KeyTail for the columns
+// after the first of a longer key.  A chain is a type of its own for every
+// pair of column types and orders, so that both columns are inlined like
+// the one of a single TupleCmp.
+template <class First, class Rest>
+class KeyChain
+{
+ public:
+	typedef KeyChain<typename First::Reversed, typename Rest::Reversed> Reversed;
+
+	KeyChain(const First& first, const Rest& rest) : _first(first), _rest(rest) {}
+
+	int operator()(const char* t1, const char* t2) const
+	{
+		int r = _first(t1, t2);
+		return (r != 0) ? r : _rest(t1, t2);
+	}
+
+	int normalizedLength() const
+	{
+		return _first.normalizedLength() + _rest.normalizedLength();
+	}
+
+	// The normalized keys of the columns one after the other; each is
+	// fixed-size, so memcmp stops at the first column that differs.
+	void normalize(const char* t, unsigned char* out) const
+	{
+		_first.normalize(t, out);
+		_rest.normalize(t, out + _first.normalizedLength());
+	}
+
+	Reversed reversed() const { return Reversed(_first.reversed(), _rest.reversed()); }
+
+ private:
+	First	_first;
+	Rest	_rest;
+};
+
+// An entry of sortByPrefix: the first 8 bytes of the normalized key of a
+// record, read big-endian so that they compare as an integer, and the
+// number of the record.
+struct PrefixEntry {
+	unsigned long long	prefix;
+	int					rec;
+};
+
+// Bytes of normalized key in a PrefixEntry.
+#define SORT_PREFIX	8
+
+// Compares the current records of two inputs of a merge, for the loser tree.
+template <class Cmp>
+class RunCmp
+{
+ public:
+	RunCmp(const Cmp& cmp, const char* const* records)
+		: _cmp(cmp), _records(records) {}
+
+	int operator()(int a, int b) const
+	{
+		return _cmp(_records[a], _records[b]);
+	}
+
+ private:
+	Cmp					_cmp;
+	const char* const*	_records;	// current record of each input
+};
+
+//*************************************************************************
+//	sortRecords sorts n records of len bytes in place: quicksort with a
+//		median-of-three pivot and Hoare's partition, which splits runs of
+//		equal keys evenly, and insertion sort for short ranges.  tmp must
+//		hold two records.
+//*************************************************************************
+template <class Cmp>
+void sortRecords(char* base, int n, int len, const Cmp& cmp, char* tmp)
+{
+	char* pivot = tmp;
+	char* swap = tmp + len;
+
+	while (n > 16) {
+		char* lo = base;
+		char* mid = base + (n/2)*len;
+		char* hi = base + (n-1)*len;
+		char* m;
+		if (cmp(lo,mid) < 0)
+			m = (cmp(mid,hi) < 0) ? mid : ((cmp(lo,hi) < 0) ? hi : lo);
+		else
+			m = (cmp(lo,hi) < 0) ? lo : ((cmp(mid,hi) < 0) ? hi : mid);
+
+		// with the pivot first, the split leaves both sides non-empty
+		memcpy(pivot, m, len);
+		if (m != lo) {
+			memcpy(m, lo, len);
+			memcpy(lo, pivot, len);
+		}
+
+		int i = -1, j = n;
+		for (;;) {
+			do i++; while (cmp(base + i*len, pivot) < 0);
+			do j--; while (cmp(pivot, base + j*len) < 0);
+			if (i >= j) break;
+			memcpy(swap, base + i*len, len);
+			memcpy(base + i*len, base + j*len, len);
+			memcpy(base + j*len, swap, len);
+		}
+
+		// [0,j] <= pivot <= (j,n): recurse into the smaller side and loop
+		// on the larger one
+		int nLeft = j+1, nRight = n-j-1;
+		if (nLeft < nRight) {
+			sortRecords(base, nLeft, len, cmp, tmp);
+			base += nLeft*len;
+			n = nRight;
+		} else {
+			sortRecords(base + nLeft*len, nRight, len, cmp, tmp);
+			n = nLeft;
+		}
+	}
+
+	for (int i=1; i<n; i++) {
+		int j = i;
+		while (j > 0 && cmp(base + (j-1)*len, base + i*len) > 0) j--;
+		if (j == i) continue;
+		memcpy(swap, base + i*len, len);
+		memmove(base + (j+1)*len, base + j*len, (i-j)*len);
+		memcpy(base + j*len, swap, len);
+	}
+}
+
+template <class Cmp>
+inline bool prefixEntryLess(const PrefixEntry& a, const PrefixEntry& b,
+					   const char* records, int len, const Cmp& cmp, bool longer)
+{
+	if (a.prefix != b.prefix) return a.prefix < b.prefix;
+	return longer && cmp(&records[a.rec*len], &records[b.rec*len]) < 0;
+}
+
+//*************************************************************************
+//	sortPrefixEntries sorts n PrefixEntry like sortRecords, by prefix and,
+//		if longer is set and the prefixes are equal, by cmp on the records
+//		the entries stand for, which are len bytes each.
+//*************************************************************************
+template <class Cmp>
+void sortPrefixEntries(PrefixEntry* e, int n, const char* records, int len,
+					   const Cmp& cmp, bool longer)
+{
+	while (n > 16) {
+		PrefixEntry* mid = &e[n/2];
+		PrefixEntry* hi = &e[n-1];
+		PrefixEntry* m;
+		if (prefixEntryLess(e[0], *mid, records, len, cmp, longer))
+			m = prefixEntryLess(*mid, *hi, records, len, cmp, longer) ? mid :
+				(prefixEntryLess(e[0], *hi, records, len, cmp, longer) ? hi : e);
+		else
+			m = prefixEntryLess(e[0], *hi, records, len, cmp, longer) ? e :
+				(prefixEntryLess(*mid, *hi, records, len, cmp, longer) ? hi : mid);
+		PrefixEntry pivot = *m;
+		*m = e[0];
+		e[0] = pivot;
+
+		int i = -1, j = n;
+		for (;;) {
+			do i++; while (prefixEntryLess(e[i], pivot, records, len, cmp, longer));
+			do j--; while (prefixEntryLess(pivot, e[j], records, len, cmp, longer));
+			if (i >= j) break;
+			PrefixEntry t = e[i];
+			e[i] = e[j];
+			e[j] = t;
+		}
+
+		int nLeft = j+1, nRight = n-j-1;
+		if (nLeft < nRight) {
+			sortPrefixEntries(e, nLeft, records, len, cmp, longer);
+			e += nLeft;
+			n = nRight;
+		} else {
+			sortPrefixEntries(e + nLeft, nRight, records, len, cmp, longer);
+			n = nLeft;
+		}
+	}
+
+	for (int i=1; i<n; i++) {
+		PrefixEntry t = e[i];
+		int j = i;
+		for (; j > 0 && prefixEntryLess(t, e[j-1], records, len, cmp, longer); j--)
+			e[j] = e[j-1];
+		e[j] = t;
+	}
+}
+
+//*************************************************************************
+//	radixSortKeys sorts n entries of width bytes, each a normalized key of
+//		keyLen bytes followed by anything, with an LSD radix sort: one
+//		counting pass per key byte, from the last byte to the first, each
+//		stable.  A byte that is the same in every key is skipped.  The
+//		entries move between entries and tmp; the sorted ones are in the
+//		buffer returned.
+//*************************************************************************
+inline char* radixSortKeys(char* entries, char* tmp, int n, int width, int keyLen)
+{
+	int count[256];
+	char* from = entries;
+	char* to = tmp;
+	for (int b=keyLen-1; b>=0; b--) {
+		memset(count, 0, sizeof(count));
+		for (int i=0; i<n; i++)
+			count[(unsigned char)from[i*width + b]]++;
+		if (n == 0 || count[(unsigned char)from[b]] == n) continue;
+
+		int start = 0;
+		for (int c=0; c<256; c++) {
+			int k = count[c];
+			count[c] = start;
+			start += k;
+		}
+		for (int i=0; i<n; i++) {
+			int c = (unsigned char)from[i*width + b];
+			memcpy(&to[(count[c]++)*width], &from[i*width], width);
+		}
+		char* t = from;
+		from = to;
+		to = t;
+	}
+	return from;
+}
+
+// The comparator a Sort or join picks at run time.  Every call does a
+// whole job -- sort a memory load, replay a merge, sift a heap -- in code
+// compiled for one key type and order, so the choice is paid once per job
+// rather than once per comparison.
+class TupleComparator
+{
+ public:
+	virtual ~TupleComparator() {}
+
+	// Compares the key of t1 with the key of t2, like strcmp.
+	virtual int compare(const char* t1, const char* t2) const = 0;
+
+	// Sorts n records of len bytes in place.
+	virtual void sort(char* records, int n, int len) const = 0;
+
+	// Bytes of the normalized key; see KeyCmp.
+	virtual int normalizedLength() const = 0;
+
+	// Writes the normalized key of t to out.
+	virtual void normalize(const char* t, unsigned char* out) const = 0;
+
+	// Sorts n records of len bytes by normalized key without moving them.
+	// entries and tmp each hold n entries of normalizedLength() plus an
+	// int.  Returns the buffer holding the sorted entries; the int after
+	// the key of each is the number of its record.
+	virtual char* radixSort(const char* records, int n, int len,
+							char* entries, char* tmp) const = 0;
+
+	// Sorts n records of len bytes without moving them: entries gets a
+	// PrefixEntry for each, and they are sorted instead.  However wide the
+	// records, a swap moves an entry, and most comparisons are of two
+	// integers.
+	virtual void sortByPrefix(const char* records, int n, int len,
+							  PrefixEntry* entries) const = 0;
+
+	// A loser tree over number inputs whose current records are
+	// records[i].  The records are not copied: the caller moves the
+	// pointers as the inputs advance.
+	virtual MergeTree* mergeTree(int number,
+								 const char* const* records) const = 0;
+
+	// Restores the heap of replacement selection from hole down.  The heap
+	// holds slot numbers, ordered by the run of the slot and then by key.
+	virtual void siftDown(int* heap, int size, int hole, const int* run,
+						  const char* records, int len) const = 0;
+
+	// A comparator of the same keys in the opposite order.  The caller
+	// deletes it.
+	virtual TupleComparator* reversed() const = 0;
+
+	// A copy, which the caller deletes.
+	virtual TupleComparator* clone() const = 0;
+};
+
+// The columns after the first of a key of three or more: a comparator of
+// their own, made like any other, and called through its virtual functions
+// only when the first column is equal.  Each chain type stays a pair of
+// columns, so there are no more of them whatever the number of columns.
+class KeyTail
+{
+ public:
+	typedef KeyTail Reversed;
+
+	// Takes over cmp.
+	KeyTail(TupleComparator* cmp) : _cmp(cmp) {}
+	KeyTail(const KeyTail& other) : _cmp(other._cmp->clone()) {}
+	~KeyTail() { delete _cmp; }
+
+	KeyTail& operator=(const KeyTail& other)
+	{
+		if (this != &other) {
+			delete _cmp;
+			_cmp = other._cmp->clone();
+		}
+		return *this;
+	}
+
+	int operator()(const char* t1, const char* t2) const
+	{
+		return _cmp->compare(t1, t2);
+	}
+
+	int normalizedLength() const { return _cmp->normalizedLength(); }
+
+	void normalize(const char* t, unsigned char* out) const
+	{
+		_cmp->normalize(t, out);
+	}
+
+	Reversed reversed() const { return KeyTail(_cmp->reversed()); }
+
+ private:
+	TupleComparator* _cmp;
+};
+
+// A TupleComparator whose jobs are compiled for the comparison Cmp: a
+// TupleCmp for a single key column, a KeyChain for several.
+template <class Cmp>
+class TypedTupleComparator : public TupleComparator
+{
+ public:
+	TypedTupleComparator(const Cmp& cmp) : _cmp(cmp) {}
+
+	int compare(const char* t1, const char* t2) const
+	{
+		return _cmp(t1, t2);
+	}
+
+	void sort(char* records, int n, int len) const
+	{
+		char* tmp = new char[2*len];
+		sortRecords(records, n, len, _cmp, tmp);
+		delete [] tmp;
+	}
+
+	int normalizedLength() const
+	{
+		return _cmp.normalizedLength();
+	}
+
+	void normalize(const char* t, unsigned char* out) const
+	{
+		_cmp.normalize(t, out);
+	}
+
+	char* radixSort(const char* records, int n, int len,
+					char* entries, char* tmp) const
+	{
+		int keyLen = _cmp.normalizedLength();
+		int width = keyLen + sizeof(int);
+		for (int i=0; i<n; i++) {
+			_cmp.normalize(&records[i*len], (unsigned char*)&entries[i*width]);
+			memcpy(&entries[i*width + keyLen], &i, sizeof(int));
+		}
+		return radixSortKeys(entries, tmp, n, width, keyLen);
+	}
+
+	void sortByPrefix(const char* records, int n, int len,
+					  PrefixEntry* entries) const
+	{
+		int keyLen = _cmp.normalizedLength();
+		int copy = (keyLen < SORT_PREFIX) ? keyLen : SORT_PREFIX;
+		unsigned char* key = new unsigned char[keyLen];
+		for (int i=0; i<n; i++) {
+			_cmp.normalize(&records[i*len], key);
+			unsigned long long prefix = 0;
+			for (int b=0; b<SORT_PREFIX; b++)
+				prefix = (prefix << 8) | ((b < copy) ? key[b] : 0);
+			entries[i].prefix = prefix;
+			entries[i].rec = i;
+		}
+		delete [] key;
+		sortPrefixEntries(entries, n, records, len, _cmp, keyLen > SORT_PREFIX);
+	}
+
+	MergeTree* mergeTree(int number, const char* const* records) const
+	{
+		return new LoserTree< RunCmp<Cmp> >(number,
+			RunCmp<Cmp>(_cmp, records));
+	}
+
+	void siftDown(int* heap, int size, int hole, const int* run,
+				  const char* records, int len) const
+	{
+		int slot = heap[hole];
+		for (;;) {
+			int child = 2*hole + 1;
+			if (child >= size) break;
+			if (child+1 < size && _less(heap[child+1], heap[child], run, records, len))
+				child++;
+			if (!_less(heap[child], slot, run, records, len)) break;
+			heap[hole] = heap[child];
+			hole = child;
+		}
+		heap[hole] = slot;
+	}
+
+	TupleComparator* reversed() const
+	{
+		return new TypedTupleComparator<typename Cmp::Reversed>(_cmp.reversed());
+	}
+
+	TupleComparator* clone() const
+	{
+		return new TypedTupleComparator<Cmp>(_cmp);
+	}
+
+ private:
+	bool _less(int a, int b, const int* run, const char* records, int len) const
+	{
+		if (run[a] != run[b]) return run[a] < run[b];
+		return _cmp(&records[a*len], &records[b*len]) < 0;
+	}
+
+	Cmp _cmp;
+};
+
+// withColumn calls make with the TupleCmp of the key column k, whose type
+// is picked here from the type and order of k, and returns what make
+// returns, or NULL if the type is not supported.
+template <class Make>
+inline TupleComparator* withColumn(const KeyField& k, const Make& make)
+{
+	switch (k.type) {
+		case attrInteger:
+			if (k.order == Ascending)
+				return make(TupleCmp<attrInteger,Ascending>(k.pos1, k.pos2, k.size));
+			return make(TupleCmp<attrInteger,Descending>(k.pos1, k.pos2, k.size));
+		case attrString:
+			if (k.order == Ascending)
+				return make(TupleCmp<attrString,Ascending>(k.pos1, k.pos2, k.size));
+			return make(TupleCmp<attrString,Descending>(k.pos1, k.pos2, k.size));
+		case attrReal:
+			if (k.order == Ascending)
+				return make(TupleCmp<attrReal,Ascending>(k.pos1, k.pos2, k.size));
+			return make(TupleCmp<attrReal,Descending>(k.pos1, k.pos2, k.size));
+		default:
+			return NULL;
+	}
+}
+
+// The comparator of a single column.
+struct MakeComparator
+{
+	template <class Cmp>
+	TupleComparator* operator()(const Cmp& cmp) const
+	{
+		return new TypedTupleComparator<Cmp>(cmp);
+	}
+};
+
+// The comparator of a column followed by rest.
+template <class Rest>
+struct MakeChain
+{
+	MakeChain(const Rest& rest) : _rest(rest) {}
+
+	template <class First>
+	TupleComparator* operator()(const First& first) const
+	{
+		return new TypedTupleComparator< KeyChain<First,Rest> >(
+			KeyChain<First,Rest>(first, _rest));
+	}
+
+	const Rest& _rest;
+};
+
+// The comparator of the column first followed by a second column.
+struct MakePair
+{
+	MakePair(const KeyField& first) : _first(first) {}
+
+	template <class Second>
+	TupleComparator* operator()(const Second& second) const
+	{
+		return withColumn(_first, MakeChain<Second>(second));
+	}
+
+	const KeyField& _first;
+};
+
+// Returns the comparator for keys of the given type and order, or NULL if
+// the key type is not supported.  The caller deletes it.
+inline TupleComparator* newTupleComparator(AttrType type, TupleOrder order,
+										   int pos1, int pos2, int size)
+{
+	KeyField k;
+	k.type = type;
+	k.order = order;
+	k.pos1 = pos1;
+	k.pos2 = pos2;
+	k.size = size;
+	return withColumn(k, MakeComparator());
+}
+
+// Returns the comparator for a key of number columns, the first deciding
+// first, or NULL if a column type is not supported.  A single column gets
+// the comparator above, two a KeyChain of both, and more a KeyChain of the
+// first and the KeyTail of the rest.  The caller deletes it.
+inline TupleComparator* newTupleComparator(int number, const KeyField keys[])
+{
+	if (number < 1) return NULL;
+	if (number == 1) return withColumn(keys[0], MakeComparator());
+	if (number == 2) return withColumn(keys[1], MakePair(keys[0]));
+	TupleComparator* rest = newTupleComparator(number-1, keys+1);
+	if (rest == NULL) return NULL;
+	return withColumn(keys[0], MakeChain<KeyTail>(KeyTail(rest)));
+}
+
+#endif